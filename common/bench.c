@@ -0,0 +1,115 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "bench.h"
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+double bench_seconds_since(uint64_t start_ns) {
+    return (bench_now_ns() - start_ns) / 1e9;
+}
+
+int bench_requested(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) return 1;
+    }
+    return 0;
+}
+
+double bench_deadline_ms(int argc, char* argv[]) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--deadline") == 0) return atof(argv[i + 1]);
+    }
+    return -1;
+}
+
+uint64_t bench_deadline_ns(double ms) {
+    if (ms < 0) return 0;
+    return bench_now_ns() + (uint64_t)(ms * 1e6);
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+//Nearest-rank percentile of sorted samples, in milliseconds
+static double percentile_ms(const uint64_t sorted[], int n, double p) {
+    int idx = (int)(p * n + 0.999999) - 1;
+    if (idx < 0) idx = 0;
+    if (idx >= n) idx = n - 1;
+    return sorted[idx] / 1e6;
+}
+
+int bench_mute_stdout(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (saved < 0 || null_fd < 0) {
+        if (saved >= 0) close(saved);
+        if (null_fd >= 0) close(null_fd);
+        return -1;
+    }
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved;
+}
+
+void bench_unmute_stdout(int saved) {
+    if (saved < 0) return;
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+void bench_run(const char* name, void (*fn)(void*), void* arg, int warmup, int iterations) {
+    if (iterations < 1) iterations = 1;
+    uint64_t* samples = malloc(sizeof(uint64_t) * iterations);
+    if (!samples) {
+        fprintf(stderr, "bench: cannot allocate %d samples\n", iterations);
+        return;
+    }
+
+    int saved = bench_mute_stdout();
+    for (int i = 0; i < warmup; i++) {
+        fn(arg);
+    }
+    uint64_t total = 0;
+    for (int i = 0; i < iterations; i++) {
+        uint64_t start = bench_now_ns();
+        fn(arg);
+        fflush(stdout);
+        samples[i] = bench_now_ns() - start;
+        total += samples[i];
+    }
+    bench_unmute_stdout(saved);
+
+    qsort(samples, iterations, sizeof(uint64_t), compare_u64);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("{\"solver\":\"%s\",\"warmup\":%d,\"iterations\":%d,"
+           "\"min_ms\":%.6f,\"median_ms\":%.6f,\"p95_ms\":%.6f,\"p99_ms\":%.6f,"
+           "\"max_ms\":%.6f,\"mean_ms\":%.6f,\"throughput_per_s\":%.3f,"
+           "\"process_peak_rss_kb\":%ld}\n",
+           name, warmup, iterations,
+           samples[0] / 1e6,
+           percentile_ms(samples, iterations, 0.50),
+           percentile_ms(samples, iterations, 0.95),
+           percentile_ms(samples, iterations, 0.99),
+           samples[iterations - 1] / 1e6,
+           total / 1e6 / iterations,
+           total > 0 ? iterations / (total / 1e9) : 0.0,
+           usage.ru_maxrss);
+    fflush(stdout);
+    free(samples);
+}
@@ -0,0 +1,37 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+#define BENCH_WARMUP 5
+#define BENCH_ITERATIONS 100
+
+//Monotonic wall-clock time in nanoseconds
+uint64_t bench_now_ns(void);
+
+//Seconds elapsed since a bench_now_ns() reading
+double bench_seconds_since(uint64_t start_ns);
+
+//True when the program was started with --bench
+int bench_requested(int argc, char* argv[]);
+
+//Milliseconds given as --deadline MS, or -1 when there is none
+double bench_deadline_ms(int argc, char* argv[]);
+
+//Absolute bench_now_ns() deadline for a budget in milliseconds; 0 (no
+//deadline) when the budget is negative
+uint64_t bench_deadline_ns(double ms);
+
+//Send stdout to /dev/null for untimed setup, returning a handle for
+//bench_unmute_stdout (-1 if muting failed)
+int bench_mute_stdout(void);
+void bench_unmute_stdout(int saved);
+
+//Run fn(arg) warmup times untimed, then iterations timed times, and print
+//one JSON line with latency percentiles, throughput and peak RSS.
+//process_peak_rss_kb is the peak of the whole process so far, so a solver
+//benched after others in the same program reports at least their peak.
+//Anything the solver prints goes to /dev/null while it runs.
+void bench_run(const char* name, void (*fn)(void*), void* arg, int warmup, int iterations);
+
+#endif
@@ -0,0 +1,155 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "labdata.h"
+
+int labdata_open(LabFile* file, const char* filename) {
+    memset(file, 0, sizeof(*file));
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Cannot open file '%s'\n", filename);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        printf("Cannot stat file '%s'\n", filename);
+        close(fd);
+        return 0;
+    }
+
+    //An empty file maps to nothing and simply has no lines
+    if (st.st_size > 0) {
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            printf("Cannot map file '%s'\n", filename);
+            close(fd);
+            return 0;
+        }
+        posix_madvise(data, st.st_size, POSIX_MADV_SEQUENTIAL);
+        file->data = data;
+        file->size = st.st_size;
+    }
+
+    close(fd);
+    return 1;
+}
+
+void labdata_close(LabFile* file) {
+    if (file->data) {
+        munmap((void*)file->data, file->size);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+int labdata_next_line(LabFile* file, LabSpan* line) {
+    if (file->offset >= file->size) return 0;
+
+    const char* begin = file->data + file->offset;
+    size_t left = file->size - file->offset;
+    const char* newline = memchr(begin, '\n', left);
+    const char* end = newline ? newline : begin + left;
+
+    file->offset = end - file->data + (newline ? 1 : 0);
+    if (end > begin && end[-1] == '\r') end--;
+
+    line->begin = begin;
+    line->end = end;
+    return 1;
+}
+
+static const char* skip_spaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+int labdata_is_blank(const LabSpan* line) {
+    return skip_spaces(line->begin, line->end) == line->end;
+}
+
+int labdata_is_eof(const LabSpan* line) {
+    const char* p = skip_spaces(line->begin, line->end);
+    if (line->end - p < 3 || memcmp(p, "EOF", 3) != 0) return 0;
+    return skip_spaces(p + 3, line->end) == line->end;
+}
+
+static void header_value(const char* colon, const LabSpan* line, LabSpan* value) {
+    if (value) {
+        value->begin = skip_spaces(colon + 1, line->end);
+        value->end = line->end;
+    }
+}
+
+int labdata_is_header(const LabSpan* line, LabSpan* value) {
+    const char* p = line->begin;
+    if (p == line->end || *p < 'A' || *p > 'Z') return 0;
+
+    while (p < line->end && ((*p >= 'A' && *p <= 'Z') || *p == ' ' || *p == '_')) p++;
+    if (p == line->end || *p != ':') return 0;
+
+    header_value(p, line, value);
+    return 1;
+}
+
+int labdata_header(const LabSpan* line, const char* key, LabSpan* value) {
+    size_t len = strlen(key);
+    if ((size_t)(line->end - line->begin) <= len) return 0;
+    if (memcmp(line->begin, key, len) != 0 || line->begin[len] != ':') return 0;
+
+    header_value(line->begin + len, line, value);
+    return 1;
+}
+
+int labdata_starts_with(const LabSpan* line, const char* text) {
+    const char* p = skip_spaces(line->begin, line->end);
+    size_t len = strlen(text);
+    return (size_t)(line->end - p) >= len && memcmp(p, text, len) == 0;
+}
+
+int labdata_int(LabSpan* cursor, int* value) {
+    const char* p = skip_spaces(cursor->begin, cursor->end);
+    int negative = 0;
+    if (p < cursor->end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    if (p == cursor->end || *p < '0' || *p > '9') return 0;
+
+    long long n = 0;
+    while (p < cursor->end && *p >= '0' && *p <= '9') {
+        n = n * 10 + (*p - '0');
+        if (n > INT_MAX) return 0;
+        p++;
+    }
+    //"12abc" is not an integer
+    if (p < cursor->end && *p != ' ' && *p != '\t') return 0;
+
+    *value = negative ? (int)-n : (int)n;
+    cursor->begin = p;
+    return 1;
+}
+
+int labdata_word(LabSpan* cursor, LabSpan* word) {
+    const char* p = skip_spaces(cursor->begin, cursor->end);
+    if (p == cursor->end) return 0;
+
+    word->begin = p;
+    while (p < cursor->end && *p != ' ' && *p != '\t') p++;
+    word->end = p;
+    cursor->begin = p;
+    return 1;
+}
+
+int labdata_copy(const LabSpan* span, char* buffer, size_t size) {
+    size_t len = span->end - span->begin;
+    if (len >= size) return 0;
+    memcpy(buffer, span->begin, len);
+    buffer[len] = '\0';
+    return 1;
+}
@@ -0,0 +1,55 @@
+#ifndef LABDATA_H
+#define LABDATA_H
+
+#include <stddef.h>
+
+//Reader for the lab data format: "KEY: value" header lines (NAME, TYPE,
+//COMMENT, ...), section marker lines, whitespace separated records and an
+//optional EOF line. The file is memory-mapped and lines are handed out as
+//spans into the mapping, so nothing is copied and no line is too long.
+
+typedef struct {
+    const char* begin;
+    const char* end;     //One past the last character, newline excluded
+} LabSpan;
+
+typedef struct {
+    const char* data;
+    size_t size;
+    size_t offset;       //Start of the next line
+} LabFile;
+
+//Map filename; prints a message and returns 0 on failure
+int labdata_open(LabFile* file, const char* filename);
+void labdata_close(LabFile* file);
+
+//Next line without its newline (or \r\n); returns 0 at end of file
+int labdata_next_line(LabFile* file, LabSpan* line);
+
+//Line is blank, or only spaces and tabs
+int labdata_is_blank(const LabSpan* line);
+
+//Line is the EOF marker
+int labdata_is_eof(const LabSpan* line);
+
+//Line is "KEY: ..." with an upper-case KEY; the value (after the colon and
+//any spaces) goes to value when non-NULL
+int labdata_is_header(const LabSpan* line, LabSpan* value);
+
+//Line is "key: ..." for this key; the value goes to value when non-NULL
+int labdata_header(const LabSpan* line, const char* key, LabSpan* value);
+
+//Line starts with text after optional leading spaces
+int labdata_starts_with(const LabSpan* line, const char* text);
+
+//Read the next integer from cursor and move cursor past it; returns 0 if
+//the next token is not an integer
+int labdata_int(LabSpan* cursor, int* value);
+
+//Read the next whitespace separated word from cursor; returns 0 if none
+int labdata_word(LabSpan* cursor, LabSpan* word);
+
+//Copy a span into a buffer of size bytes; returns 0 if it does not fit
+int labdata_copy(const LabSpan* span, char* buffer, size_t size);
+
+#endif
@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "trace.h"
+
+static TraceStats scopes[TRACE_MAX_SCOPES] = {{"main"}};
+static int scope_count = 1;
+TraceStats* trace_current = &scopes[0];
+
+static void dump_at_exit(void) {
+    const char* format = getenv("TRACE_FORMAT");
+    fflush(stdout);
+    trace_dump(stdout, format && strcmp(format, "json") == 0);
+}
+
+void trace_scope(const char* name) {
+    static int registered = 0;
+    if (!registered) {
+        atexit(dump_at_exit);
+        registered = 1;
+    }
+
+    for (int i = 0; i < scope_count; i++) {
+        if (strcmp(scopes[i].name, name) == 0) {
+            trace_current = &scopes[i];
+            return;
+        }
+    }
+    //Out of slots: keep counting into the last one
+    if (scope_count == TRACE_MAX_SCOPES) {
+        trace_current = &scopes[TRACE_MAX_SCOPES - 1];
+        return;
+    }
+    scopes[scope_count].name = name;
+    trace_current = &scopes[scope_count++];
+}
+
+static TracePhase* find_phase(const char* name) {
+    TraceStats* s = trace_current;
+    for (int i = 0; i < s->phase_count; i++) {
+        if (strcmp(s->phases[i].name, name) == 0) return &s->phases[i];
+    }
+    if (s->phase_count == TRACE_MAX_PHASES) return NULL;
+    s->phases[s->phase_count].name = name;
+    return &s->phases[s->phase_count++];
+}
+
+void trace_phase_begin(const char* name) {
+    TracePhase* p = find_phase(name);
+    if (p) p->started_ns = bench_now_ns();
+}
+
+void trace_phase_end(const char* name) {
+    TracePhase* p = find_phase(name);
+    if (p) p->total_ns += bench_now_ns() - p->started_ns;
+}
+
+static int is_empty(const TraceStats* s) {
+    for (int c = 0; c < TRACE_COUNTERS; c++) {
+        if (s->counters[c]) return 0;
+    }
+    return s->frontier_max == 0 && s->phase_count == 0;
+}
+
+void trace_dump(FILE* out, int json) {
+    static const char* counter_names[TRACE_COUNTERS] = {
+        "expanded", "generated", "pruned", "backtracked"
+    };
+
+    for (int i = 0; i < scope_count; i++) {
+        const TraceStats* s = &scopes[i];
+        if (is_empty(s)) continue;
+
+        if (json) {
+            fprintf(out, "{\"scope\":\"%s\"", s->name);
+            for (int c = 0; c < TRACE_COUNTERS; c++) {
+                fprintf(out, ",\"%s\":%llu", counter_names[c], (unsigned long long)s->counters[c]);
+            }
+            fprintf(out, ",\"frontier_max\":%llu,\"phases_s\":{", (unsigned long long)s->frontier_max);
+            for (int p = 0; p < s->phase_count; p++) {
+                fprintf(out, "%s\"%s\":%.9f", p ? "," : "", s->phases[p].name, s->phases[p].total_ns / 1e9);
+            }
+            fprintf(out, "}}\n");
+        } else {
+            fprintf(out, "\n[stats] %s:", s->name);
+            for (int c = 0; c < TRACE_COUNTERS; c++) {
+                fprintf(out, " %s=%llu", counter_names[c], (unsigned long long)s->counters[c]);
+            }
+            fprintf(out, " frontier_max=%llu\n", (unsigned long long)s->frontier_max);
+            for (int p = 0; p < s->phase_count; p++) {
+                fprintf(out, "[stats] %s: phase %s %.6f s\n", s->name, s->phases[p].name, s->phases[p].total_ns / 1e9);
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+//Search instrumentation, selected at compile time with -DTRACE_LEVEL=n:
+//  0  nothing; every TRACE_* macro compiles away
+//  1  counters, frontier high-water mark and phase timers, dumped at exit
+//  2  level 1 plus a line per TRACE_EVENT (expansions, generated nodes)
+//The exit dump is text, or one JSON object per scope when the
+//environment has TRACE_FORMAT=json.
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 1
+#endif
+
+#define TRACE_MAX_SCOPES 16
+#define TRACE_MAX_PHASES 8
+
+typedef enum {
+    TRACE_EXPANDED,
+    TRACE_GENERATED,
+    TRACE_PRUNED,
+    TRACE_BACKTRACKED,
+    TRACE_COUNTERS
+} TraceCounter;
+
+typedef struct {
+    const char* name;
+    uint64_t total_ns;
+    uint64_t started_ns;
+} TracePhase;
+
+//Statistics for one solver; TRACE_SCOPE picks which one counts
+typedef struct {
+    const char* name;
+    uint64_t counters[TRACE_COUNTERS];
+    uint64_t frontier_max;
+    TracePhase phases[TRACE_MAX_PHASES];
+    int phase_count;
+} TraceStats;
+
+extern TraceStats* trace_current;
+
+void trace_scope(const char* name);
+void trace_phase_begin(const char* name);
+void trace_phase_end(const char* name);
+void trace_dump(FILE* out, int json);
+
+#if TRACE_LEVEL >= 1
+#define TRACE_SCOPE(name) trace_scope(name)
+#define TRACE_COUNT(counter) (trace_current->counters[counter]++)
+#define TRACE_ADD(counter, n) (trace_current->counters[counter] += (n))
+#define TRACE_FRONTIER(size) \
+    do { \
+        if ((uint64_t)(size) > trace_current->frontier_max) \
+            trace_current->frontier_max = (size); \
+    } while (0)
+#define TRACE_PHASE_BEGIN(name) trace_phase_begin(name)
+#define TRACE_PHASE_END(name) trace_phase_end(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_COUNT(counter) ((void)0)
+#define TRACE_ADD(counter, n) ((void)0)
+#define TRACE_FRONTIER(size) ((void)0)
+#define TRACE_PHASE_BEGIN(name) ((void)0)
+#define TRACE_PHASE_END(name) ((void)0)
+#endif
+
+#if TRACE_LEVEL >= 2
+#define TRACE_EVENT(...) printf(__VA_ARGS__)
+#else
+#define TRACE_EVENT(...) ((void)0)
+#endif
+
+#endif
@@ -1,45 +1,52 @@
 #include <stdio.h>
 #include <string.h>
-#include <time.h>
+#include "bench.h"
+#include "labdata.h"
+#include "trace.h"
 
-#define MAX_ITEMS 11
+#define MAX_ITEMS 1024
+#define EXHAUSTIVE_MAX_ITEMS 11  //Largest instance DFS/BFS are run on
 
 //File Reading
 int read_data(const char* filename, int values[], int weights[], int* capacity) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        printf("Cannot open file '%s'\n", filename);
+    LabFile file;
+    if (!labdata_open(&file, filename)) {
         return 0;
     }
     
-    char line[100];
+    LabSpan line, value;
     int count = 0;
     int reading = 0;
     
-    while (fgets(line, sizeof(line), file)) {
-        //Remove newline
-        line[strcspn(line, "\n")] = 0;
-        
+    while (labdata_next_line(&file, &line)) {
         //Skip empty lines
-        if (strlen(line) == 0) continue;
+        if (labdata_is_blank(&line)) continue;
         
-        if (strstr(line, "MAXIMUM WEIGHT:")) {
-            sscanf(line, "MAXIMUM WEIGHT: %d", capacity);
+        if (labdata_header(&line, "MAXIMUM WEIGHT", &value)) {
+            labdata_int(&value, capacity);
             continue;
         }
         
-        if (strstr(line, "ID b w")) {
+        //Skip other header lines
+        if (labdata_is_header(&line, NULL)) continue;
+        
+        if (labdata_starts_with(&line, "ID b w")) {
             reading = 1;
             continue;
         }
         
-        if (strstr(line, "EOF")) {
+        if (labdata_is_eof(&line)) {
             break;
         }
         
         if (reading) {
             int id, v, w;
-            if (sscanf(line, "%d %d %d", &id, &v, &w) == 3) {
+            if (labdata_int(&line, &id) && labdata_int(&line, &v) && labdata_int(&line, &w)) {
+                if (count == MAX_ITEMS) {
+                    printf("Too many items, at most %d\n", MAX_ITEMS);
+                    labdata_close(&file);
+                    return 0;
+                }
                 values[count] = v;
                 weights[count] = w;
                 count++;
@@ -47,7 +54,7 @@ int read_data(const char* filename, int values[], int weights[], int* capacity)
         }
     }
     
-    fclose(file);
+    labdata_close(&file);
     
     if (count == 0) {
         printf("Warning: No items loaded from file\n");
@@ -62,33 +69,51 @@ int dfs_values[MAX_ITEMS], dfs_weights[MAX_ITEMS];
 int dfs_capacity, dfs_n;
 
 void dfs(int level, int value, int weight) {
+    TRACE_FRONTIER(level);  //Recursion depth
+    
     if (level == dfs_n) {
         if (value > dfs_best && weight <= dfs_capacity) {
             dfs_best = value;
         }
+        TRACE_COUNT(TRACE_BACKTRACKED);
         return;
     }
+    TRACE_COUNT(TRACE_EXPANDED);
     
     //Take item
     if (weight + dfs_weights[level] <= dfs_capacity) {
+        TRACE_COUNT(TRACE_GENERATED);
         dfs(level + 1, value + dfs_values[level], weight + dfs_weights[level]);
+    } else {
+        TRACE_COUNT(TRACE_PRUNED);
     }
     
     //Skip item
+    TRACE_COUNT(TRACE_GENERATED);
     dfs(level + 1, value, weight);
 }
 
-int solve_dfs(const char* filename) {
+//Search the items already loaded into the dfs_* globals
+int dfs_search(void) {
     dfs_best = 0;
+    TRACE_PHASE_BEGIN("search");
+    dfs(0, 0, 0);
+    TRACE_PHASE_END("search");
+    return dfs_best;
+}
+
+int solve_dfs(const char* filename) {
+    TRACE_SCOPE("knapsack_dfs");
+    TRACE_PHASE_BEGIN("load");
     dfs_n = read_data(filename, dfs_values, dfs_weights, &dfs_capacity);
+    TRACE_PHASE_END("load");
     
     if (dfs_n == 0) return -1;
     
-    clock_t start = clock();
-    dfs(0, 0, 0);
-    clock_t end = clock();
+    uint64_t start = bench_now_ns();
+    dfs_search();
     
-    double time_taken = ((double)(end - start)) / CLOCKS_PER_SEC;
+    double time_taken = bench_seconds_since(start);
     printf("DFS Time: %.6f seconds\n", time_taken);
     
     return dfs_best;
@@ -99,15 +124,10 @@ typedef struct {
     int level, value, weight;
 } Node;
 
-int bfs(const char* filename) {
-    int values[MAX_ITEMS], weights[MAX_ITEMS];
-    int capacity, n;
-    
-    n = read_data(filename, values, weights, &capacity);
-    if (n == 0) return -1;
-    
-    #define QUEUE_SIZE 2048  //Try smaller?
-    
+#define QUEUE_SIZE 2048  //Try smaller?
+
+//Returns the best value, or -1 if the queue overflowed
+int bfs_search(const int values[], const int weights[], int capacity, int n) {
     Node queue[QUEUE_SIZE];
     int front = 0, rear = 0;
     int best = 0;
@@ -115,15 +135,17 @@ int bfs(const char* filename) {
     
     queue[rear++] = (Node){0, 0, 0};
 
-    clock_t start = clock();
+    TRACE_PHASE_BEGIN("search");
     
     while (front < rear) {
         //Track maximum queue usage
         if (rear - front > max_used) {
             max_used = rear - front;
         }
+        TRACE_FRONTIER(rear - front);
        
         Node current = queue[front++];
+        TRACE_COUNT(TRACE_EXPANDED);
         
         if (current.level == n) {
             if (current.value > best && current.weight <= capacity) {
@@ -138,7 +160,12 @@ int bfs(const char* filename) {
             best = current.value;
         }
         } else {  //Not a leaf 
+            if (rear == QUEUE_SIZE) {
+                printf("BFS queue full\n");
+                return -1;
+            }
             queue[rear++] = (Node){current.level + 1, current.value, current.weight};
+            TRACE_COUNT(TRACE_GENERATED);
         }
 
         //Take item branch (if weight allows)
@@ -153,18 +180,188 @@ int bfs(const char* filename) {
                 best = new_value;
             }
         } else {  //Not a leaf
+            if (rear == QUEUE_SIZE) {
+                printf("BFS queue full\n");
+                return -1;
+            }
             queue[rear++] = (Node){new_level, new_value, new_weight};
+            TRACE_COUNT(TRACE_GENERATED);
         }
+    } else {
+        TRACE_COUNT(TRACE_PRUNED);
     }
 }
-    clock_t end = clock();
-    double time_taken = ((double)(end - start)) / CLOCKS_PER_SEC;
+    TRACE_PHASE_END("search");
+    
+    return best;
+}
+
+int bfs(const char* filename) {
+    int values[MAX_ITEMS], weights[MAX_ITEMS];
+    int capacity, n;
+    
+    TRACE_SCOPE("knapsack_bfs");
+    TRACE_PHASE_BEGIN("load");
+    n = read_data(filename, values, weights, &capacity);
+    TRACE_PHASE_END("load");
+    if (n == 0) return -1;
+    
+    uint64_t start = bench_now_ns();
+    int best = bfs_search(values, weights, capacity, n);
+    if (best < 0) return -1;
+    
+    double time_taken = bench_seconds_since(start);
     printf("BFS Time: %.6f seconds\n", time_taken);
     
     return best;
 }
 
 
+//Anytime Branch and Bound
+//Items are taken in value/weight order. The incumbent starts as the greedy
+//ratio solution and only improves; a subtree is cut when its fractional
+//(LP) bound cannot beat it. When the deadline passes, the search stops
+//and every subtree still pending on the stack reports its bound instead,
+//so the result carries a proven upper bound on the optimum.
+#define DEADLINE_CHECK_INTERVAL 1024  //Nodes between clock reads
+
+typedef struct {
+    int value;      //Best solution found
+    int bound;      //No solution is worth more than this
+    int complete;   //Search finished, value is optimal
+} AnytimeResult;
+
+int bb_values[MAX_ITEMS], bb_weights[MAX_ITEMS];
+int bb_capacity, bb_n;
+int bb_best, bb_greedy, bb_open_bound, bb_timed_out;
+long bb_nodes;
+uint64_t bb_deadline;
+
+//Best value reachable below this node if items could be split
+int fractional_bound(int level, int value, int weight) {
+    double bound = value;
+    int room = bb_capacity - weight;
+    for (int i = level; i < bb_n; i++) {
+        if (bb_weights[i] <= room) {
+            room -= bb_weights[i];
+            bound += bb_values[i];
+        } else {
+            bound += (double)bb_values[i] * room / bb_weights[i];
+            break;
+        }
+    }
+    return (int)bound;
+}
+
+void branch_and_bound(int level, int value, int weight) {
+    bb_nodes++;
+    if (!bb_timed_out && bb_deadline && bb_nodes % DEADLINE_CHECK_INTERVAL == 0 &&
+        bench_now_ns() >= bb_deadline) {
+        bb_timed_out = 1;
+    }
+    
+    if (value > bb_best) {
+        bb_best = value;
+    }
+    if (level == bb_n) {
+        TRACE_COUNT(TRACE_BACKTRACKED);
+        return;
+    }
+    
+    int bound = fractional_bound(level, value, weight);
+    if (bound <= bb_best) {
+        TRACE_COUNT(TRACE_PRUNED);
+        return;
+    }
+    //Out of time: leave the subtree open and remember what it could hold
+    if (bb_timed_out) {
+        if (bound > bb_open_bound) bb_open_bound = bound;
+        return;
+    }
+    TRACE_COUNT(TRACE_EXPANDED);
+    TRACE_FRONTIER(level);
+    
+    //Take item
+    if (weight + bb_weights[level] <= bb_capacity) {
+        TRACE_COUNT(TRACE_GENERATED);
+        branch_and_bound(level + 1, value + bb_values[level], weight + bb_weights[level]);
+    }
+    
+    //Skip item
+    TRACE_COUNT(TRACE_GENERATED);
+    branch_and_bound(level + 1, value, weight);
+}
+
+//Solve items already in memory; deadline_ms < 0 runs to completion
+AnytimeResult anytime_search(const int values[], const int weights[], int capacity, int n,
+                             double deadline_ms) {
+    AnytimeResult result;
+    bb_n = n;
+    bb_capacity = capacity;
+    bb_deadline = bench_deadline_ns(deadline_ms);
+    
+    //Sort items by value/weight ratio, best first
+    int order[MAX_ITEMS];
+    for (int i = 0; i < bb_n; i++) order[i] = i;
+    for (int i = 1; i < bb_n; i++) {
+        int item = order[i], j = i;
+        while (j > 0 && (long)values[item] * weights[order[j - 1]] >
+                        (long)values[order[j - 1]] * weights[item]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = item;
+    }
+    for (int i = 0; i < bb_n; i++) {
+        bb_values[i] = values[order[i]];
+        bb_weights[i] = weights[order[i]];
+    }
+    
+    //Greedy incumbent: take every item that still fits, in ratio order
+    int room = bb_capacity;
+    bb_best = 0;
+    for (int i = 0; i < bb_n; i++) {
+        if (bb_weights[i] <= room) {
+            room -= bb_weights[i];
+            bb_best += bb_values[i];
+        }
+    }
+    bb_greedy = bb_best;
+    
+    bb_open_bound = 0;
+    bb_timed_out = 0;
+    bb_nodes = 0;
+    TRACE_PHASE_BEGIN("search");
+    branch_and_bound(0, 0, 0);
+    TRACE_PHASE_END("search");
+    
+    result.value = bb_best;
+    result.complete = !bb_timed_out;
+    result.bound = bb_open_bound > bb_best ? bb_open_bound : bb_best;
+    return result;
+}
+
+//deadline_ms < 0 runs to completion
+AnytimeResult solve_anytime(const char* filename, double deadline_ms) {
+    AnytimeResult result = {-1, -1, 0};
+    int values[MAX_ITEMS], weights[MAX_ITEMS];
+    int capacity, n;
+    
+    TRACE_SCOPE("knapsack_anytime");
+    TRACE_PHASE_BEGIN("load");
+    n = read_data(filename, values, weights, &capacity);
+    TRACE_PHASE_END("load");
+    if (n == 0) return result;
+    
+    uint64_t start = bench_now_ns();
+    result = anytime_search(values, weights, capacity, n, deadline_ms);
+    
+    double time_taken = bench_seconds_since(start);
+    printf("Greedy start: %d\n", bb_greedy);
+    printf("Anytime Time: %.6f seconds (%ld nodes)\n", time_taken, bb_nodes);
+    return result;
+}
+
 //Print items
 void print_items(const char* filename) {
     int values[MAX_ITEMS], weights[MAX_ITEMS];
@@ -186,8 +383,71 @@ void print_items(const char* filename) {
 }
 
 
-int main() {
+//Benchmark entry points, timing only the search on items loaded by main
+void bench_dfs(void* unused) {
+    TRACE_SCOPE("knapsack_dfs");
+    dfs_search();
+}
+
+void bench_bfs(void* unused) {
+    TRACE_SCOPE("knapsack_bfs");
+    bfs_search(dfs_values, dfs_weights, dfs_capacity, dfs_n);
+}
+
+void bench_anytime(void* unused) {
+    TRACE_SCOPE("knapsack_anytime");
+    anytime_search(dfs_values, dfs_weights, dfs_capacity, dfs_n, -1);
+}
+
+void print_anytime(AnytimeResult r) {
+    double gap = r.bound > 0 ? 100.0 * (r.bound - r.value) / r.bound : 0;
+    printf("Anytime Result: %d, bound %d, gap %.2f%%%s\n", r.value, r.bound, gap,
+           r.complete ? " (optimal)" : " (deadline reached)");
+}
+
+int main(int argc, char* argv[]) {
+    //Usage: knapsack [file] [--deadline MS] [--bench]
     const char* filename = "lab1/data/knapsack.txt";  
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--deadline") == 0) {
+            i++;
+        } else if (strncmp(argv[i], "--", 2) != 0) {
+            filename = argv[i];
+        }
+    }
+    
+    if (bench_requested(argc, argv)) {
+        int saved = bench_mute_stdout();
+        dfs_n = read_data(filename, dfs_values, dfs_weights, &dfs_capacity);
+        bench_unmute_stdout(saved);
+        if (dfs_n == 0) return 1;
+        bench_run("knapsack_dfs", bench_dfs, NULL, BENCH_WARMUP, BENCH_ITERATIONS);
+        bench_run("knapsack_bfs", bench_bfs, NULL, BENCH_WARMUP, BENCH_ITERATIONS);
+        bench_run("knapsack_anytime", bench_anytime, NULL, BENCH_WARMUP, BENCH_ITERATIONS);
+        return 0;
+    }
+    
+    //With a time budget only the anytime solver runs
+    double deadline_ms = bench_deadline_ms(argc, argv);
+    if (deadline_ms >= 0) {
+        printf("  Knapsack 0/1 - Anytime B&B, deadline %.3f ms\n", deadline_ms);
+        AnytimeResult r = solve_anytime(filename, deadline_ms);
+        if (r.value < 0) return 1;
+        print_anytime(r);
+        return 0;
+    }
+    
+    //Exhaustive DFS/BFS only fit small instances; bigger ones get B&B
+    int values[MAX_ITEMS], weights[MAX_ITEMS], capacity;
+    int n = read_data(filename, values, weights, &capacity);
+    if (n == 0) return 1;
+    if (n > EXHAUSTIVE_MAX_ITEMS) {
+        printf("  Knapsack 0/1 - %d items, too many for DFS/BFS, running B&B\n", n);
+        AnytimeResult r = solve_anytime(filename, -1);
+        if (r.value < 0) return 1;
+        print_anytime(r);
+        return 0;
+    }
     
     printf("  Knapsack 0/1 - BFS vs DFS\n");
     
@@ -199,6 +459,10 @@ int main() {
     
     //Run DFS
     int dfs_result = solve_dfs(filename);
+    if (dfs_result < 0) {
+        printf("No items to solve\n");
+        return 1;
+    }
     printf("DFS Result: %d\n\n", dfs_result);
     
     //Run BFS  
@@ -1,9 +1,16 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include "bench.h"
+#include "labdata.h"
+#include "trace.h"
 
 #define MAX_CITIES 100
+#define MAX_ROADS 200
 #define MAX_NAME 50
+#define INF 1000000000
+#define ARA_START_WEIGHT 3.0
+#define ARA_WEIGHT_STEP 0.5
 
 typedef struct {
     char from[MAX_NAME], to[MAX_NAME];
@@ -15,61 +22,72 @@ typedef struct {
     int h;  //heuristic 
 } City;
 
-Road roads[200];
+Road roads[MAX_ROADS];
 City cities[MAX_CITIES];
 int road_count = 0, city_count = 0;
 
 //Data loading
 void load_data() {
-    FILE* f = fopen("lab1/data/spain.txt", "r");
-    if (!f) {
-        printf("Cannot open data/spain.txt\n");
+    LabFile f;
+    if (!labdata_open(&f, "lab1/data/spain.txt")) {
         exit(1);
     }
     
-    char line[200];
+    LabSpan line, a, b;
     int read_roads = 0;
     
-    while (fgets(line, sizeof(line), f)) {
+    while (labdata_next_line(&f, &line)) {
         // Skip empty lines and headers
-        if (strlen(line) < 3) continue;
-        if (strstr(line, "NAME:")) continue;
-        if (strstr(line, "TYPE:")) continue;
-        if (strstr(line, "COMMENT:")) continue;
+        if (labdata_is_blank(&line)) continue;
+        if (labdata_is_header(&line, NULL)) continue;
+        if (labdata_is_eof(&line)) break;
         
         // Start reading roads
-        if (strstr(line, "A B Distance")) {
+        if (labdata_starts_with(&line, "A B Distance")) {
             read_roads = 1;
             continue;
         }
         
         // Start reading heuristics
-        if (strstr(line, "Straight line")) {
+        if (labdata_starts_with(&line, "Straight line")) {
             read_roads = 0;
             continue;
         }
         
-        char a[MAX_NAME], b[MAX_NAME];
         int d;
         
         if (read_roads) {
             // Read road: CityA CityB Distance
-            if (sscanf(line, "%s %s %d", a, b, &d) == 3) {
-                strcpy(roads[road_count].from, a);
-                strcpy(roads[road_count].to, b);
+            if (labdata_word(&line, &a) && labdata_word(&line, &b) && labdata_int(&line, &d)) {
+                if (road_count == MAX_ROADS) {
+                    printf("Too many roads, at most %d\n", MAX_ROADS);
+                    exit(1);
+                }
+                if (!labdata_copy(&a, roads[road_count].from, MAX_NAME) ||
+                    !labdata_copy(&b, roads[road_count].to, MAX_NAME)) {
+                    printf("City name too long, at most %d characters\n", MAX_NAME - 1);
+                    exit(1);
+                }
                 roads[road_count].dist = d;
                 road_count++;
             }
         } else {
             // Read heuristic: City Distance
-            if (sscanf(line, "%s %d", a, &d) == 2) {
-                strcpy(cities[city_count].name, a);
+            if (labdata_word(&line, &a) && labdata_int(&line, &d)) {
+                if (city_count == MAX_CITIES) {
+                    printf("Too many cities, at most %d\n", MAX_CITIES);
+                    exit(1);
+                }
+                if (!labdata_copy(&a, cities[city_count].name, MAX_NAME)) {
+                    printf("City name too long, at most %d characters\n", MAX_NAME - 1);
+                    exit(1);
+                }
                 cities[city_count].h = d;
                 city_count++;
             }
         }
     }
-    fclose(f);
+    labdata_close(&f);
     
     printf("Loaded %d roads, %d cities\n", road_count, city_count);
 }
@@ -121,6 +139,9 @@ void print_path(int idx) {
 //GREEDY
 void greedy_search() {
     printf("\n GREEDY BEST-FIRST \n");
+    node_count = 0;
+    TRACE_SCOPE("spain_greedy");
+    TRACE_PHASE_BEGIN("search");
     
     Node* open[1000];
     int open_count = 0;
@@ -148,10 +169,12 @@ void greedy_search() {
             open[i] = open[i + 1];
         open_count--;
         
-        printf("Expanding: %s (path distance=%d, h=%d)\n", current->city, current->cost, current->total);
+        TRACE_COUNT(TRACE_EXPANDED);
+        TRACE_EVENT("Expanding: %s (path distance=%d, h=%d)\n", current->city, current->cost, current->total);
         
         // Goal check
         if (strcmp(current->city, "Valladolid") == 0) {
+            TRACE_PHASE_END("search");
             printf("\nGreedy path found!\nPath: ");
             print_path(current - nodes);
             printf("\nTotal distance: %d km\n", current->cost);
@@ -182,12 +205,17 @@ void greedy_search() {
                     int idx = create_node(neighbor, current->cost + road_cost, h, current - nodes);
                     open[open_count++] = &nodes[idx];
                     strcpy(visited[visited_count++], neighbor);
-                    printf("  -> %s (path distance=%d, h=%d)\n", neighbor, nodes[idx].cost, h);
+                    TRACE_COUNT(TRACE_GENERATED);
+                    TRACE_FRONTIER(open_count);
+                    TRACE_EVENT("  -> %s (path distance=%d, h=%d)\n", neighbor, nodes[idx].cost, h);
+                } else {
+                    TRACE_COUNT(TRACE_PRUNED);
                 }
             }
         }
     }
     
+    TRACE_PHASE_END("search");
     printf("\nNo path found!\n");
 }
 
@@ -195,6 +223,9 @@ void greedy_search() {
 //A*
 void astar_search() {
     printf("\n A* SEARCH \n");
+    node_count = 0;
+    TRACE_SCOPE("spain_astar");
+    TRACE_PHASE_BEGIN("search");
     
     Node* open[1000];
     int open_count = 0;
@@ -226,13 +257,15 @@ void astar_search() {
             open[i] = open[i + 1];
         open_count--;
         
-        printf("Expanding: %s (g=%d, h=%d, f=%d)\n", 
-               current->city, current->cost, 
-               current->total - current->cost,  // h = f - g
-               current->total);
+        TRACE_COUNT(TRACE_EXPANDED);
+        TRACE_EVENT("Expanding: %s (g=%d, h=%d, f=%d)\n", 
+                    current->city, current->cost, 
+                    current->total - current->cost,  // h = f - g
+                    current->total);
         
         // Goal check
         if (strcmp(current->city, "Valladolid") == 0) {
+            TRACE_PHASE_END("search");
             printf("\nA* optimal path found!\nPath: ");
             print_path(current - nodes);
             printf("\nTotal distance: %d km\n", current->cost);  // g = total distance
@@ -275,16 +308,223 @@ void astar_search() {
                         g_values[found] = g_new;
                     }
                     
-                    printf("  -> %s (g=%d, h=%d, f=%d)\n", 
-                           neighbor, g_new, h_new, f_new);
+                    TRACE_COUNT(TRACE_GENERATED);
+                    TRACE_FRONTIER(open_count);
+                    TRACE_EVENT("  -> %s (g=%d, h=%d, f=%d)\n", 
+                                neighbor, g_new, h_new, f_new);
+                } else {
+                    TRACE_COUNT(TRACE_PRUNED);
                 }
             }
         }
     }
+    TRACE_PHASE_END("search");
     printf("\nNo path found!\n");
 }
 
-int main() {
+//ARA*
+//Weighted A* (f = g + w*h) run with a shrinking weight. Each round keeps
+//the g values from the one before; nodes improved after being closed wait
+//in INCONS and rejoin OPEN when the weight drops. Every round ends with a
+//path at most w times optimal, and min(g + h) over OPEN and INCONS is a
+//proven lower bound, so the search can stop at a deadline with a gap.
+typedef struct {
+    int cost;       //Best path cost found, INF if none yet
+    int bound;      //Optimal cost is at least this
+    int complete;   //Path is proven optimal
+} AnytimeResult;
+
+int city_index(char* name) {
+    for (int i = 0; i < city_count; i++) {
+        if (strcmp(cities[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+int ara_g[MAX_CITIES], ara_parent[MAX_CITIES];
+char ara_open[MAX_CITIES], ara_closed[MAX_CITIES], ara_incons[MAX_CITIES];
+int ara_path[MAX_CITIES], ara_path_len;
+
+void ara_print_path() {
+    for (int i = ara_path_len - 1; i >= 0; i--) {
+        printf("%s%s", cities[ara_path[i]].name, i ? " -> " : "");
+    }
+    printf("\n");
+}
+
+//Expand until the goal's g is no larger than the smallest weighted f in
+//OPEN; returns 0 if the deadline passed first
+int ara_improve_path(int goal, double w, uint64_t deadline) {
+    while (1) {
+        int best = -1;
+        double best_f = 0;
+        for (int i = 0; i < city_count; i++) {
+            if (!ara_open[i]) continue;
+            double f = ara_g[i] + w * cities[i].h;
+            if (best == -1 || f < best_f) {
+                best = i;
+                best_f = f;
+            }
+        }
+        if (best == -1 || ara_g[goal] <= best_f) return 1;
+        if (deadline && bench_now_ns() >= deadline) return 0;
+        
+        ara_open[best] = 0;
+        ara_closed[best] = 1;
+        TRACE_COUNT(TRACE_EXPANDED);
+        TRACE_EVENT("Expanding: %s (g=%d, h=%d, w=%.2f)\n", cities[best].name, ara_g[best], cities[best].h, w);
+        
+        for (int i = 0; i < road_count; i++) {
+            char* neighbor = NULL;
+            if (strcmp(roads[i].from, cities[best].name) == 0)
+                neighbor = roads[i].to;
+            else if (strcmp(roads[i].to, cities[best].name) == 0)
+                neighbor = roads[i].from;
+            if (!neighbor) continue;
+            
+            int n = city_index(neighbor);
+            if (n < 0) continue;
+            int g_new = ara_g[best] + roads[i].dist;
+            if (g_new >= ara_g[n]) {
+                TRACE_COUNT(TRACE_PRUNED);
+                continue;
+            }
+            
+            ara_g[n] = g_new;
+            ara_parent[n] = best;
+            if (ara_closed[n]) {
+                ara_incons[n] = 1;
+            } else {
+                ara_open[n] = 1;
+            }
+            TRACE_COUNT(TRACE_GENERATED);
+        }
+        
+        int open_size = 0;
+        for (int i = 0; i < city_count; i++) open_size += ara_open[i];
+        TRACE_FRONTIER(open_size);
+    }
+}
+
+//deadline_ms < 0 runs until the path is proven optimal
+AnytimeResult ara_star_search(char* from, char* to, double deadline_ms) {
+    printf("\n ARA* SEARCH \n");
+    TRACE_SCOPE("spain_ara");
+    TRACE_PHASE_BEGIN("search");
+    uint64_t deadline = bench_deadline_ns(deadline_ms);
+    AnytimeResult result = {INF, 0, 0};
+    
+    int start = city_index(from), goal = city_index(to);
+    if (start < 0 || goal < 0) {
+        printf("Unknown city\n");
+        TRACE_PHASE_END("search");
+        return result;
+    }
+    
+    for (int i = 0; i < city_count; i++) {
+        ara_g[i] = INF;
+        ara_parent[i] = -1;
+        ara_open[i] = ara_closed[i] = ara_incons[i] = 0;
+    }
+    ara_g[start] = 0;
+    ara_open[start] = 1;
+    ara_path_len = 0;
+    
+    double w = ARA_START_WEIGHT;
+    while (1) {
+        int finished = ara_improve_path(goal, w, deadline);
+        
+        //OPEN ran dry without reaching the goal: no weight can change that
+        if (finished && ara_g[goal] == INF) {
+            result.complete = 1;
+            break;
+        }
+        
+        //Keep the path if this round improved it
+        if (ara_g[goal] < result.cost) {
+            result.cost = ara_g[goal];
+            ara_path_len = 0;
+            for (int c = goal; c != -1; c = ara_parent[c])
+                ara_path[ara_path_len++] = c;
+        }
+        
+        //Lower bound on the optimum from everything not yet settled
+        int bound = result.cost;
+        for (int i = 0; i < city_count; i++) {
+            if ((ara_open[i] || ara_incons[i]) && ara_g[i] + cities[i].h < bound)
+                bound = ara_g[i] + cities[i].h;
+        }
+        result.bound = bound;
+        
+        if (finished && result.cost < INF) {
+            printf("w=%.2f: %d km, within %.3f of optimal\n", w, result.cost,
+                   bound > 0 ? (double)result.cost / bound : 1.0);
+        }
+        if (!finished) break;
+        if (w <= 1.0 || bound >= result.cost) {
+            result.complete = 1;
+            break;
+        }
+        
+        //Lower the weight, move INCONS into OPEN and start a fresh round
+        w = w - ARA_WEIGHT_STEP < 1.0 ? 1.0 : w - ARA_WEIGHT_STEP;
+        for (int i = 0; i < city_count; i++) {
+            if (ara_incons[i]) ara_open[i] = 1;
+            ara_incons[i] = 0;
+            ara_closed[i] = 0;
+        }
+    }
+    TRACE_PHASE_END("search");
+    
+    if (result.cost == INF) {
+        if (result.complete) {
+            printf("\nNo path exists!\n");
+        } else {
+            printf("\nNo path found before the deadline (optimal is at least %d km)\n", result.bound);
+        }
+        return result;
+    }
+    printf("\nARA* %s path found!\nPath: ", result.complete ? "optimal" : "best-so-far");
+    ara_print_path();
+    printf("Total distance: %d km, lower bound %d km, gap %.2f%%\n", result.cost, result.bound,
+           100.0 * (result.cost - result.bound) / result.cost);
+    return result;
+}
+
+//Benchmark entry points
+void bench_greedy(void* unused) {
+    greedy_search();
+}
+
+void bench_astar(void* unused) {
+    astar_search();
+}
+
+void bench_ara(void* unused) {
+    ara_star_search("Malaga", "Valladolid", -1);
+}
+
+int main(int argc, char* argv[]) {
+    if (bench_requested(argc, argv)) {
+        int saved = bench_mute_stdout();
+        load_data();
+        bench_unmute_stdout(saved);
+        bench_run("spain_greedy", bench_greedy, NULL, BENCH_WARMUP, BENCH_ITERATIONS);
+        bench_run("spain_astar", bench_astar, NULL, BENCH_WARMUP, BENCH_ITERATIONS);
+        bench_run("spain_ara", bench_ara, NULL, BENCH_WARMUP, BENCH_ITERATIONS);
+        return 0;
+    }
+    
+    //With a time budget only the anytime search runs
+    double deadline_ms = bench_deadline_ms(argc, argv);
+    if (deadline_ms >= 0) {
+        printf("Malaga to Valladolid, deadline %.3f ms\n", deadline_ms);
+        load_data();
+        ara_star_search("Malaga", "Valladolid", deadline_ms);
+        return 0;
+    }
+    
     printf("Malaga to Valladolid\n");
     
     load_data();
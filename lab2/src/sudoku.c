@@ -2,6 +2,9 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include "bench.h"
+#include "labdata.h"
+#include "trace.h"
 
 #define SIZE 9
 #define MAX_SUDOKUS 10
@@ -49,30 +52,37 @@ bool find_empty(int grid[SIZE][SIZE], int *row, int *col) {
     return false;
 }
 
-//Backtracking solver
-bool solve(int grid[SIZE][SIZE]) {
+//Backtracking solver, depth = placements currently on the stack
+bool solve(int grid[SIZE][SIZE], int depth) {
     int row, col;
     
+    TRACE_FRONTIER(depth);  //Recursion depth
+    
     //If no empty cells, puzzle is solved
     if (!find_empty(grid, &row, &col)) {
         return true;
     }
+    TRACE_COUNT(TRACE_EXPANDED);
     
     //Try numbers 1 through 9
     for (int num = 1; num <= 9; num++) {
         //Check if valid
-        if (is_valid(grid, row, col, num)) {
+        if (!is_valid(grid, row, col, num)) {
+            TRACE_COUNT(TRACE_PRUNED);
+        } else {
             //Try placing number
             grid[row][col] = num;
+            TRACE_COUNT(TRACE_GENERATED);
             
             //Recursively try to solve 
-            if (solve(grid)) {
+            if (solve(grid, depth + 1)) {
                 return true;
             }
             
             // If we get here, our choice didn't work
             // Backtrack (undo the placement)
             grid[row][col] = 0;
+            TRACE_COUNT(TRACE_BACKTRACKED);
         }
     }
     
@@ -104,35 +114,29 @@ void print_grid(int grid[SIZE][SIZE]) {
 
 //Read all Sudokus from file
 int read_sudokus_from_file(char* filename, int sudokus[][SIZE][SIZE]) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        printf("Error opening file %s\n", filename);
+    LabFile file;
+    if (!labdata_open(&file, filename)) {
         return 0;
     }
     
-    char line[50];
+    LabSpan line;
     int current_sudoku = -1;
     int row = 0;
     int count = 0;
     
     //Read until EOF
-    while (fgets(line, sizeof(line), file) != NULL) {
-        //Remove newline
-        line[strcspn(line, "\n")] = '\0';
-        
+    while (labdata_next_line(&file, &line)) {
         //Skip empty lines
-        if (strlen(line) == 0) continue;
+        if (labdata_is_blank(&line)) continue;
         
         //Stop at EOF marker
-        if (strstr(line, "EOF") != NULL) break;
+        if (labdata_is_eof(&line)) break;
         
         //Skip other header lines
-        if (strstr(line, "NAME:") != NULL) continue;
-        if (strstr(line, "TYPE:") != NULL) continue;
-        if (strstr(line, "COMMENT:") != NULL) continue;
+        if (labdata_is_header(&line, NULL)) continue;
         
         //Check if this is a new Sudoku header
-        if (strstr(line, "SUDOKU") != NULL) {
+        if (labdata_starts_with(&line, "SUDOKU")) {
             current_sudoku++;
             row = 0;
             continue;
@@ -140,9 +144,9 @@ int read_sudokus_from_file(char* filename, int sudokus[][SIZE][SIZE]) {
         
         //Only process if we have a valid Sudoku and valid line
         if (current_sudoku >= 0 && current_sudoku < MAX_SUDOKUS && 
-            row < SIZE && strlen(line) >= SIZE) {
+            row < SIZE && line.end - line.begin >= SIZE) {
             for (int col = 0; col < SIZE; col++) {
-                sudokus[current_sudoku][row][col] = line[col] - '0';
+                sudokus[current_sudoku][row][col] = line.begin[col] - '0';
             }
             row++;
             
@@ -153,19 +157,46 @@ int read_sudokus_from_file(char* filename, int sudokus[][SIZE][SIZE]) {
         }
     }
     
-    fclose(file);
+    labdata_close(&file);
     return count;
 }
 
-int main() {
+//Benchmark entry point: solve every loaded puzzle from scratch
+typedef struct {
+    int (*sudokus)[SIZE][SIZE];
+    int count;
+} SudokuSet;
+
+void bench_solve_all(void* arg) {
+    SudokuSet* set = arg;
+    TRACE_SCOPE("sudoku_backtracking");
+    int grid[SIZE][SIZE];
+    for (int s = 0; s < set->count; s++) {
+        memcpy(grid, set->sudokus[s], sizeof(grid));
+        solve(grid, 0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (bench_requested(argc, argv)) {
+        int sudokus[MAX_SUDOKUS][SIZE][SIZE];
+        SudokuSet set = {sudokus, read_sudokus_from_file("lab2/data/sudoku.txt", sudokus)};
+        bench_run("sudoku_backtracking", bench_solve_all, &set, BENCH_WARMUP, BENCH_ITERATIONS);
+        return 0;
+    }
+    
     printf("SUDOKU SOLVER (Backtracking/DFS)\n");
     
     //Array to store all puzzles
     int sudokus[MAX_SUDOKUS][SIZE][SIZE];
     int sudoku_count = 0;
     
+    TRACE_SCOPE("sudoku_backtracking");
+    
     //Read from file
+    TRACE_PHASE_BEGIN("load");
     sudoku_count = read_sudokus_from_file("lab2/data/sudoku.txt", sudokus);
+    TRACE_PHASE_END("load");
     
     
     printf("Found %d Sudoku puzzle(s)\n\n", sudoku_count);
@@ -188,7 +219,11 @@ int main() {
         
         printf("Solving...\n");
         
-        if (solve(grid)) {
+        TRACE_PHASE_BEGIN("solve");
+        bool solved = solve(grid, 0);
+        TRACE_PHASE_END("solve");
+        
+        if (solved) {
             printf("\nSolved puzzle:\n");
             print_grid(grid);
         } else {
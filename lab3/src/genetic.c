@@ -1,10 +1,45 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "bench.h"
+#include "trace.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define POP_SIZE 10
+#define GENERATIONS 20
+#define MUTATION_RATE 0.2
+#define NEIGHBORS 8      //Candidate list length for local search
+#define OR_OPT_MAX 3     //Longest segment moved by Or-opt
+#define EPS 1e-9
+#define MATRIX_LIMIT (1UL << 30)  //Bytes; bigger instances use coordinates
+#define HK_MAX_CITIES 25          //Held-Karp needs (n-1) * 2^(n-2) doubles
+#define HK_AUTO_CITIES 20         //Exact solve without -x (~40 MB, under a second)
+#define HK_MAX_THREADS 64
+#define BENCH_CITIES 1000
+#define BENCH_GENERATIONS 10
+#define BENCH_SEED 42
+
+//Cities are 0-based; build with -DCITY_ID_BITS=16 to halve tour storage
+//for instances of at most 65535 cities
+#if defined(CITY_ID_BITS) && CITY_ID_BITS == 16
+typedef uint16_t city_t;
+#define MAX_CITIES 65535
+#else
+typedef uint32_t city_t;
+#define MAX_CITIES 10000000
+#endif
 
 // Real distance matrix for 5 cities (simplified)
 // Cities at positions: 1:(0,0), 2:(1,0), 3:(1,1), 4:(0,1), 5:(0.5,0.5)
-double dist_matrix[5][5] = {
+double example_matrix[5][5] = {
     {0, 1.0, 1.4, 1.0, 0.7},  // From city 1
     {1.0, 0, 1.0, 1.4, 0.7},  // From city 2
     {1.4, 1.0, 0, 1.0, 0.7},  // From city 3
@@ -12,87 +47,842 @@ double dist_matrix[5][5] = {
     {0.7, 0.7, 0.7, 0.7, 0}   // From city 5
 };
 
-double route_distance(int route[6]) {
-    double total = 0;
-    for(int i = 0; i < 5; i++) {
-        total += dist_matrix[route[i]-1][route[i+1]-1];
+int n_cities;
+double* dist_matrix;  //n_cities x n_cities, row-major; NULL = use coordinates
+float* city_x;        //Coordinates of random instances, NULL for the example
+float* city_y;
+
+static inline double dist(int a, int b) {
+    if(dist_matrix) return dist_matrix[(size_t)a * n_cities + b];
+    float dx = city_x[a] - city_x[b];
+    float dy = city_y[a] - city_y[b];
+    return sqrtf(dx * dx + dy * dy);
+}
+
+//Tours are open arrays of n_cities ids with city 0 first; the closing
+//edge back to it is implied
+double route_distance(const city_t* tour) {
+    double total = dist(tour[n_cities-1], tour[0]);
+    for(int i = 0; i < n_cities - 1; i++) {
+        total += dist(tour[i], tour[i+1]);
     }
     return total;
 }
 
-int main() {
-    srand(time(NULL));
-    
-    printf("=== REAL TSP EXAMPLE ===\n\n");
-    
-    // Our 5 random routes from before (converted to 0-based)
-    int population[5][6] = {
-        {1,4,5,2,3,1},  // 1→4→5→2→3→1
-        {1,5,4,2,3,1},  // 1→5→4→2→3→1  
-        {1,2,5,4,3,1},  // 1→2→5→4→3→1
-        {1,3,5,2,4,1},  // 1→3→5→2→4→1
-        {1,4,5,2,3,1}   // 1→4→5→2→3→1
-    };
-    
-    printf("GENERATION 0 (Initial Random):\n");
-    double best_dist = 1000;
+#if defined(__x86_64__)
+//Same sum, eight (coordinates) or four (matrix) edges per step with
+//gathers for the per-edge lookups
+#if defined(CITY_ID_BITS) && CITY_ID_BITS == 16
+#define LOAD4(p) _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(p)))
+#define LOAD8(p) _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(p)))
+#else
+#define LOAD4(p) _mm_loadu_si128((const __m128i*)(p))
+#define LOAD8(p) _mm256_loadu_si256((const __m256i*)(p))
+#endif
+
+__attribute__((target("avx2")))
+double route_distance_avx2(const city_t* tour) {
+    int i = 0;
+    __m256d acc = _mm256_setzero_pd();
+
+    if(dist_matrix) {
+        __m128i stride = _mm_set1_epi32(n_cities);
+        for(; i + 4 < n_cities; i += 4) {
+            __m128i from = LOAD4(tour + i);
+            __m128i to = LOAD4(tour + i + 1);
+            __m128i idx = _mm_add_epi32(_mm_mullo_epi32(from, stride), to);
+            acc = _mm256_add_pd(acc, _mm256_i32gather_pd(dist_matrix, idx, 8));
+        }
+    } else {
+        for(; i + 8 < n_cities; i += 8) {
+            __m256i from = LOAD8(tour + i);
+            __m256i to = LOAD8(tour + i + 1);
+            __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(city_x, from, 4),
+                                      _mm256_i32gather_ps(city_x, to, 4));
+            __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(city_y, from, 4),
+                                      _mm256_i32gather_ps(city_y, to, 4));
+            __m256 d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx),
+                                                    _mm256_mul_ps(dy, dy)));
+            acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm256_castps256_ps128(d)));
+            acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm256_extractf128_ps(d, 1)));
+        }
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for(; i < n_cities - 1; i++) {
+        total += dist(tour[i], tour[i+1]);
+    }
+    return total + dist(tour[n_cities-1], tour[0]);
+}
+#endif
+
+//Fitness of count tours stored back to back in pop
+void evaluate_population(const city_t* pop, int count, double fitness[]) {
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2")) {
+        for(int i = 0; i < count; i++)
+            fitness[i] = route_distance_avx2(pop + (size_t)i * n_cities);
+        return;
+    }
+#endif
+    for(int i = 0; i < count; i++)
+        fitness[i] = route_distance(pop + (size_t)i * n_cities);
+}
+
+void print_route(const city_t* tour) {
+    for(int j = 0; j < n_cities; j++) printf("%d ", tour[j] + 1);
+    printf("%d ", tour[0] + 1);
+}
+
+//Instances
+void load_example() {
+    n_cities = 5;
+    dist_matrix = malloc(sizeof(double) * 25);
+    for(int i = 0; i < 5; i++)
+        for(int j = 0; j < 5; j++)
+            dist_matrix[i * 5 + j] = example_matrix[i][j];
+}
+
+//Random Euclidean cities in a 1000x1000 square. The n x n matrix is only
+//built when it fits under MATRIX_LIMIT and on_the_fly is not set.
+void generate_cities(int n, int on_the_fly) {
+    n_cities = n;
+    city_x = malloc(sizeof(float) * n);
+    city_y = malloc(sizeof(float) * n);
+    for(int i = 0; i < n; i++) {
+        city_x[i] = 1000.0 * rand() / RAND_MAX;
+        city_y[i] = 1000.0 * rand() / RAND_MAX;
+    }
+
+    size_t bytes = sizeof(double) * n * n;
+    if(on_the_fly || bytes > MATRIX_LIMIT) {
+        printf("Distances computed on the fly from coordinates\n");
+        return;
+    }
+
+    dist_matrix = malloc(bytes);
+    if(!dist_matrix) {
+        printf("Cannot allocate distance matrix, using coordinates\n");
+        return;
+    }
+    for(int i = 0; i < n; i++) {
+        for(int j = 0; j < n; j++) {
+            float dx = city_x[i] - city_x[j];
+            float dy = city_y[i] - city_y[j];
+            dist_matrix[(size_t)i * n + j] = sqrtf(dx * dx + dy * dy);
+        }
+    }
+}
+
+//Local search (2-opt + Or-opt)
+//Works on a 0-based open tour with a position index, so every move is
+//priced in O(1) from the handful of edges it touches. Candidate moves only
+//pair a city with its nearest neighbors, and don't-look bits (cities not in
+//the queue) skip cities whose surroundings have not changed.
+int k_neighbors;
+int* neighbors;       //n_cities x k_neighbors, nearest first
+int* ls_tour;         //ls_tour[i] = city at position i
+int* ls_pos;          //ls_pos[c] = position of city c
+int* ls_queue;
+char* ls_active;      //Don't-look bit cleared = city is queued
+int queue_head, queue_count;
+
+//Keep list/best sorted with the k closest candidates seen so far
+void insert_neighbor(int list[], double best[], int* found, int j, double d) {
+    if(*found == k_neighbors && d >= best[*found - 1]) return;
+
+    int k = *found < k_neighbors ? (*found)++ : k_neighbors - 1;
+    while(k > 0 && best[k - 1] > d) {
+        best[k] = best[k - 1];
+        list[k] = list[k - 1];
+        k--;
+    }
+    best[k] = d;
+    list[k] = j;
+}
+
+//Bucket the cities into a uniform grid and search rings of cells outward,
+//stopping once the next ring cannot hold anything closer
+void build_neighbors_grid(double best[]) {
+    float min_x = city_x[0], max_x = city_x[0];
+    float min_y = city_y[0], max_y = city_y[0];
+    for(int i = 1; i < n_cities; i++) {
+        if(city_x[i] < min_x) min_x = city_x[i];
+        if(city_x[i] > max_x) max_x = city_x[i];
+        if(city_y[i] < min_y) min_y = city_y[i];
+        if(city_y[i] > max_y) max_y = city_y[i];
+    }
+
+    int side = (int)sqrt(n_cities / 2.0);
+    if(side < 1) side = 1;
+    double span = max_x - min_x > max_y - min_y ? max_x - min_x : max_y - min_y;
+    double cell = span > 0 ? span / side : 1;
+
+    int* cell_of = malloc(sizeof(int) * n_cities);
+    int* cell_start = calloc((size_t)side * side + 1, sizeof(int));
+    int* members = malloc(sizeof(int) * n_cities);
+    for(int i = 0; i < n_cities; i++) {
+        int cx = (int)((city_x[i] - min_x) / cell);
+        int cy = (int)((city_y[i] - min_y) / cell);
+        if(cx >= side) cx = side - 1;
+        if(cy >= side) cy = side - 1;
+        cell_of[i] = cy * side + cx;
+        cell_start[cell_of[i] + 1]++;
+    }
+    for(int c = 0; c < side * side; c++) cell_start[c + 1] += cell_start[c];
+    int* fill = malloc(sizeof(int) * side * side);
+    memcpy(fill, cell_start, sizeof(int) * side * side);
+    for(int i = 0; i < n_cities; i++) members[fill[cell_of[i]]++] = i;
+
+    for(int i = 0; i < n_cities; i++) {
+        int* list = &neighbors[(size_t)i * k_neighbors];
+        int found = 0;
+        int cx = cell_of[i] % side, cy = cell_of[i] / side;
+
+        for(int r = 0; r < side; r++) {
+            for(int y = cy - r; y <= cy + r; y++) {
+                if(y < 0 || y >= side) continue;
+                int on_edge = (y == cy - r || y == cy + r);
+                for(int x = cx - r; x <= cx + r; x += on_edge ? 1 : 2 * r) {
+                    if(x >= 0 && x < side) {
+                        int c = y * side + x;
+                        for(int m = cell_start[c]; m < cell_start[c + 1]; m++) {
+                            int j = members[m];
+                            if(j != i) insert_neighbor(list, best, &found, j, dist(i, j));
+                        }
+                    }
+                    if(r == 0) break;
+                }
+            }
+            if(found == k_neighbors && best[found - 1] <= r * cell) break;
+        }
+    }
+
+    free(cell_of);
+    free(cell_start);
+    free(members);
+    free(fill);
+}
+
+void build_neighbors() {
+    k_neighbors = n_cities - 1 < NEIGHBORS ? n_cities - 1 : NEIGHBORS;
+    neighbors = malloc(sizeof(int) * n_cities * k_neighbors);
+    double* best = malloc(sizeof(double) * k_neighbors);
+
+    if(city_x) {
+        build_neighbors_grid(best);
+        free(best);
+        return;
+    }
+
+    for(int i = 0; i < n_cities; i++) {
+        int* list = &neighbors[(size_t)i * k_neighbors];
+        int found = 0;
+        for(int j = 0; j < n_cities; j++) {
+            if(j != i) insert_neighbor(list, best, &found, j, dist(i, j));
+        }
+    }
+    free(best);
+}
+
+void init_local_search() {
+    build_neighbors();
+    ls_tour = malloc(sizeof(int) * n_cities);
+    ls_pos = malloc(sizeof(int) * n_cities);
+    ls_queue = malloc(sizeof(int) * n_cities);
+    ls_active = malloc(n_cities);
+}
+
+void push_city(int c) {
+    if(ls_active[c]) return;
+    ls_active[c] = 1;
+    ls_queue[(queue_head + queue_count) % n_cities] = c;
+    queue_count++;
+    TRACE_FRONTIER(queue_count);
+}
+
+int pop_city() {
+    int c = ls_queue[queue_head];
+    queue_head = (queue_head + 1) % n_cities;
+    queue_count--;
+    ls_active[c] = 0;
+    return c;
+}
+
+int succ(int c) { return ls_tour[(ls_pos[c] + 1) % n_cities]; }
+int pred(int c) { return ls_tour[(ls_pos[c] - 1 + n_cities) % n_cities]; }
+
+//dir 0 walks the tour forward, dir 1 backward
+int step(int c, int dir) { return dir ? pred(c) : succ(c); }
+
+//Reverse positions i..j (wrapping); flips the complement if it is shorter,
+//which gives the same cycle for a symmetric TSP
+void reverse_segment(int i, int j) {
+    int len = (j - i + n_cities) % n_cities + 1;
+    if(2 * len > n_cities) {
+        int t = i;
+        i = (j + 1) % n_cities;
+        j = (t - 1 + n_cities) % n_cities;
+        len = n_cities - len;
+    }
+
+    for(int k = 0; k < len / 2; k++) {
+        int a = ls_tour[i], b = ls_tour[j];
+        ls_tour[i] = b; ls_pos[b] = i;
+        ls_tour[j] = a; ls_pos[a] = j;
+        i = (i + 1) % n_cities;
+        j = (j - 1 + n_cities) % n_cities;
+    }
+}
+
+//Replace edges (a,b),(c,d) with (a,c),(b,d). Both edges must point the
+//same way round the tour, either b = succ(a), d = succ(c) or both pred.
+void apply_2opt(int a, int b, int c, int d) {
+    if(succ(a) != b) {
+        int t = a; a = b; b = t;
+        t = c; c = d; d = t;
+    }
+    reverse_segment(ls_pos[b], ls_pos[c]);
+}
+
+int improve_2opt(int a) {
+    for(int dir = 0; dir < 2; dir++) {
+        int b = step(a, dir);
+        double d_ab = dist(a, b);
+
+        for(int k = 0; k < k_neighbors; k++) {
+            int c = neighbors[(size_t)a * k_neighbors + k];
+            double d_ac = dist(a, c);
+            if(d_ac >= d_ab) {  //No gain possible from further neighbors
+                TRACE_COUNT(TRACE_PRUNED);
+                break;
+            }
+
+            int d = step(c, dir);
+            if(c == b || d == a) continue;
+
+            TRACE_COUNT(TRACE_GENERATED);
+            double delta = d_ac + dist(b, d) - d_ab - dist(c, d);
+            if(delta < -EPS) {
+                apply_2opt(a, b, c, d);
+                push_city(a); push_city(b); push_city(c); push_city(d);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+//Move segment s1..s2 (running in direction dir, with outer ends p and nx)
+//between c and d = step(c, dir). With forward set the result is
+//c-s1..s2-d, otherwise c-s2..s1-d. Built from at most three 2-opt moves.
+void apply_or_opt(int p, int s1, int s2, int nx, int c, int d, int forward) {
+    apply_2opt(p, s1, c, d);
+    apply_2opt(p, c, nx, s2);
+    if(forward && s1 != s2) {
+        apply_2opt(c, s2, s1, d);
+    }
+}
+
+int in_segment(int c, int seg[], int len) {
+    for(int i = 0; i < len; i++)
+        if(seg[i] == c) return 1;
+    return 0;
+}
+
+int improve_or_opt(int a) {
+    int max_len = n_cities - 3 < OR_OPT_MAX ? n_cities - 3 : OR_OPT_MAX;
+
+    for(int dir = 0; dir < 2; dir++) {
+        int seg[OR_OPT_MAX];
+        int s1 = a, s2 = a;
+        int p = step(a, !dir);
+        seg[0] = a;
+
+        for(int len = 1; len <= max_len; len++) {
+            if(len > 1) {
+                s2 = step(s2, dir);
+                seg[len - 1] = s2;
+            }
+            int nx = step(s2, dir);
+            double removed = dist(p, s1) + dist(s2, nx) - dist(p, nx);
+            if(removed <= EPS) continue;
+
+            for(int k = 0; k < k_neighbors; k++) {
+                int c = neighbors[(size_t)s1 * k_neighbors + k];
+                double d_cs1 = dist(c, s1);
+                if(d_cs1 >= removed) {
+                    TRACE_COUNT(TRACE_PRUNED);
+                    break;
+                }
+                if(in_segment(c, seg, len)) continue;
+                TRACE_COUNT(TRACE_GENERATED);
+
+                //Insert as c-s1..s2-next(c)
+                int d = step(c, dir);
+                if(c != p && d != p) {
+                    double added = d_cs1 + dist(s2, d) - dist(c, d);
+                    if(added < removed - EPS) {
+                        apply_or_opt(p, s1, s2, nx, c, d, 1);
+                        push_city(p); push_city(nx); push_city(s1);
+                        push_city(s2); push_city(c); push_city(d);
+                        return 1;
+                    }
+                }
+
+                //Insert as prev(c)-s2..s1-c
+                int e = step(c, !dir);
+                if(c != nx && c != p) {
+                    double added = dist(e, s2) + d_cs1 - dist(e, c);
+                    if(added < removed - EPS) {
+                        apply_or_opt(p, s1, s2, nx, e, c, 0);
+                        push_city(p); push_city(nx); push_city(s1);
+                        push_city(s2); push_city(e); push_city(c);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+//Run 2-opt and Or-opt to a local optimum, then write the tour back
+//starting at city 0
+void local_search(city_t* tour) {
+    if(n_cities < 5) return;
+
+    queue_head = 0;
+    queue_count = 0;
+    memset(ls_active, 0, n_cities);
+    for(int i = 0; i < n_cities; i++) {
+        ls_tour[i] = tour[i];
+        ls_pos[ls_tour[i]] = i;
+        push_city(ls_tour[i]);
+    }
+
+    while(queue_count > 0) {
+        int a = pop_city();
+        TRACE_COUNT(TRACE_EXPANDED);
+        if(!improve_2opt(a)) {
+            improve_or_opt(a);
+        }
+    }
+
+    int start = ls_pos[0];
+    for(int i = 0; i < n_cities; i++) {
+        tour[i] = ls_tour[(start + i) % n_cities];
+    }
+}
+
+//Held-Karp exact solver
+//cost(S, j) = shortest path from city 0 through every city in S ending at
+//j in S. Cities 1..n-1 map to bits 0..n-2. Each subset size k gets its
+//own level holding C(m,k) blocks of k costs, one block per subset in
+//colex order and one cost per member in bit order, so nothing is stored
+//for j outside S. Level k only reads level k-1, so every level is split
+//into rank ranges that run on separate threads.
+int hk_m;                                       //Cities besides city 0
+double hk_dist[HK_MAX_CITIES][HK_MAX_CITIES];
+uint64_t hk_binom[HK_MAX_CITIES + 1][HK_MAX_CITIES + 1];
+double* hk_level[HK_MAX_CITIES];                //hk_level[k], k = 1..hk_m
+
+typedef struct {
+    int k;
+    uint64_t begin, end;                        //Rank range in level k
+} HkRange;
+
+uint64_t hk_rank(uint32_t set) {
+    uint64_t rank = 0;
+    for(int i = 1; set; i++) {
+        int b = __builtin_ctz(set);
+        rank += hk_binom[b][i];
+        set &= set - 1;
+    }
+    return rank;
+}
+
+uint32_t hk_unrank(uint64_t rank, int k) {
+    uint32_t set = 0;
+    for(int i = k; i > 0; i--) {
+        int b = i - 1;
+        while(hk_binom[b + 1][i] <= rank) b++;
+        rank -= hk_binom[b][i];
+        set |= 1u << b;
+    }
+    return set;
+}
+
+//Best way to reach j (bit) through set, using level k-1
+double hk_best_into(uint32_t set, int k, int j, int* from) {
+    uint32_t prev = set & ~(1u << j);
+    const double* block = hk_level[k - 1] + hk_rank(prev) * (k - 1);
+    double best = -1;
+    int idx = 0;
+    for(uint32_t rest = prev; rest; rest &= rest - 1, idx++) {
+        int i = __builtin_ctz(rest);
+        double c = block[idx] + hk_dist[i + 1][j + 1];
+        if(best < 0 || c < best) {
+            best = c;
+            *from = i;
+        }
+    }
+    return best;
+}
+
+void* hk_worker(void* arg) {
+    HkRange* r = arg;
+    int k = r->k;
+    if(r->begin >= r->end) return NULL;
+
+    uint32_t set = hk_unrank(r->begin, k);
+    double* out = hk_level[k] + r->begin * k;
+    for(uint64_t rank = r->begin; rank < r->end; rank++) {
+        int idx = 0, from;
+        for(uint32_t rest = set; rest; rest &= rest - 1, idx++) {
+            out[idx] = hk_best_into(set, k, __builtin_ctz(rest), &from);
+        }
+        out += k;
+
+        //Next subset of the same size (Gosper's hack, colex order)
+        uint32_t low = set & -set;
+        uint32_t high = set + low;
+        set = high | (((set ^ high) >> 2) / low);
+    }
+    return NULL;
+}
+
+//Fill tour with a proven-optimal route starting at city 0 and return its
+//length, or -1 if the instance is too big or memory runs out
+double held_karp(city_t* tour) {
+    if(n_cities > HK_MAX_CITIES || n_cities < 3) return -1;
+    hk_m = n_cities - 1;
+
+    for(int a = 0; a < n_cities; a++)
+        for(int b = 0; b < n_cities; b++)
+            hk_dist[a][b] = dist(a, b);
+    for(int a = 0; a <= HK_MAX_CITIES; a++) {
+        hk_binom[a][0] = 1;
+        for(int b = 1; b <= HK_MAX_CITIES; b++)
+            hk_binom[a][b] = a == 0 ? 0 : hk_binom[a - 1][b - 1] + hk_binom[a - 1][b];
+    }
+
+    printf("Held-Karp: %.1f MB for %d cities\n",
+           sizeof(double) * (double)hk_m * (1ull << (hk_m - 1)) / (1 << 20), n_cities);
+    fflush(stdout);
+    for(int k = 1; k <= hk_m; k++) {
+        hk_level[k] = malloc(sizeof(double) * hk_binom[hk_m][k] * k);
+        if(!hk_level[k]) {
+            printf("Held-Karp: out of memory at subset size %d\n", k);
+            for(int i = 1; i < k; i++) free(hk_level[i]);
+            return -1;
+        }
+    }
+    for(int j = 0; j < hk_m; j++) {
+        hk_level[1][j] = hk_dist[0][j + 1];
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus < 1 ? 1 : cpus > HK_MAX_THREADS ? HK_MAX_THREADS : (int)cpus;
+    pthread_t tid[HK_MAX_THREADS];
+    int started[HK_MAX_THREADS];
+    HkRange ranges[HK_MAX_THREADS];
+
+    for(int k = 2; k <= hk_m; k++) {
+        uint64_t count = hk_binom[hk_m][k];
+        TRACE_ADD(TRACE_EXPANDED, count);
+        int t_used = count < 1024 ? 1 : threads;
+        for(int t = 0; t < t_used; t++) {
+            ranges[t] = (HkRange){k, count * t / t_used, count * (t + 1) / t_used};
+            started[t] = t_used > 1 && pthread_create(&tid[t], NULL, hk_worker, &ranges[t]) == 0;
+            if(!started[t]) hk_worker(&ranges[t]);
+        }
+        for(int t = 0; t < t_used; t++) {
+            if(started[t]) pthread_join(tid[t], NULL);
+        }
+    }
+
+    //Close the cycle, then walk back through the levels
+    uint32_t set = (1u << hk_m) - 1;
+    double best = -1;
+    int last = 0, idx = 0;
+    for(uint32_t rest = set; rest; rest &= rest - 1, idx++) {
+        int j = __builtin_ctz(rest);
+        double c = hk_level[hk_m][idx] + hk_dist[j + 1][0];
+        if(best < 0 || c < best) {
+            best = c;
+            last = j;
+        }
+    }
+
+    tour[0] = 0;
+    for(int k = hk_m; k >= 1; k--) {
+        tour[k] = last + 1;
+        int from = last;
+        if(k > 1) hk_best_into(set, k, last, &from);
+        set &= ~(1u << last);
+        last = from;
+    }
+
+    for(int k = 1; k <= hk_m; k++) free(hk_level[k]);
+    return best;
+}
+
+//Genetic operators
+void random_route(city_t* tour) {
+    for(int i = 0; i < n_cities; i++) tour[i] = i;
+    for(int i = n_cities - 1; i > 1; i--) {
+        int j = 1 + rand() % i;
+        city_t t = tour[i]; tour[i] = tour[j]; tour[j] = t;
+    }
+}
+
+//Greedy nearest-neighbor tour from a random city, rotated so city 0 is
+//first. Looks in the neighbor list first and only scans the unvisited
+//cities when all listed neighbors are taken.
+void nearest_neighbor_route(city_t* tour, char used[], int unvisited[]) {
+    int left = n_cities;
+    for(int i = 0; i < n_cities; i++) unvisited[i] = i;
+    memset(used, 0, n_cities);
+
+    int current = rand() % n_cities;
+    for(int i = 0; i < n_cities; i++) {
+        tour[i] = current;
+        used[current] = 1;
+        if(i == n_cities - 1) break;
+
+        int next = -1;
+        for(int k = 0; k < k_neighbors && next < 0; k++) {
+            int c = neighbors[(size_t)current * k_neighbors + k];
+            if(!used[c]) next = c;
+        }
+        if(next < 0) {
+            double best = 0;
+            for(int m = 0; m < left; m++) {
+                int c = unvisited[m];
+                if(used[c]) {
+                    unvisited[m--] = unvisited[--left];
+                    continue;
+                }
+                double d = dist(current, c);
+                if(next < 0 || d < best) {
+                    best = d;
+                    next = c;
+                }
+            }
+        }
+        current = next;
+    }
+
+    //Rotate city 0 to the front
+    int shift = 0;
+    while(tour[shift] != 0) shift++;
+    for(int i = 0; i < n_cities; i++) unvisited[i] = tour[(shift + i) % n_cities];
+    for(int i = 0; i < n_cities; i++) tour[i] = unvisited[i];
+}
+
+int tournament(double fitness[]) {
+    int a = rand() % POP_SIZE;
+    int b = rand() % POP_SIZE;
+    return fitness[a] < fitness[b] ? a : b;
+}
+
+//Order crossover: keep a segment of parent 1, fill the rest in parent 2's
+//order. City 0 stays fixed in front.
+void crossover(const city_t* p1, const city_t* p2, city_t* child, char used[]) {
+    int inner = n_cities - 1;
+    int i = 1 + rand() % inner;
+    int j = 1 + rand() % inner;
+    if(i > j) { int t = i; i = j; j = t; }
+
+    memset(used, 0, n_cities);
+    for(int k = i; k <= j; k++) {
+        child[k] = p1[k];
+        used[p1[k]] = 1;
+    }
+
+    int pos = j % inner + 1;
+    for(int k = 0; k < inner; k++) {
+        city_t city = p2[(j + k) % inner + 1];
+        if(used[city]) continue;
+        child[pos] = city;
+        pos = pos % inner + 1;
+    }
+    child[0] = 0;
+}
+
+void mutate(city_t* tour) {
+    if(n_cities < 3 || (double)rand() / RAND_MAX >= MUTATION_RATE) return;
+    int i = 1 + rand() % (n_cities - 1);
+    int j = 1 + rand() % (n_cities - 1);
+    city_t t = tour[i]; tour[i] = tour[j]; tour[j] = t;
+}
+
+//Evolve a population for the given generations; copies the best tour
+//found into best and returns its length
+double run_ga(int generations, city_t* best) {
+    TRACE_SCOPE("tsp_genetic");
+    TRACE_PHASE_BEGIN("init");
+
+    //Two flat generations of POP_SIZE tours each, swapped every generation
+    size_t stride = n_cities;
+    city_t* population = malloc(sizeof(city_t) * stride * POP_SIZE);
+    city_t* new_pop = malloc(sizeof(city_t) * stride * POP_SIZE);
+    double fitness[POP_SIZE];
+    char* used = malloc(n_cities);
+    int* scratch = malloc(sizeof(int) * n_cities);
+
+    //Generation 0: random routes polished by local search; big instances
+    //start from nearest-neighbor tours so the first polish stays cheap
+    for(int i = 0; i < POP_SIZE; i++) {
+        if(n_cities > 1000) {
+            nearest_neighbor_route(population + i * stride, used, scratch);
+        } else {
+            random_route(population + i * stride);
+        }
+        local_search(population + i * stride);
+    }
+    evaluate_population(population, POP_SIZE, fitness);
+    TRACE_PHASE_END("init");
+    TRACE_PHASE_BEGIN("evolve");
+
     int best_idx = 0;
-    
-    for(int i = 0; i < 5; i++) {
-        double d = route_distance(population[i]);
-        printf("Person %d: ", i+1);
-        for(int j = 0; j < 6; j++) printf("%d ", population[i][j]);
-        printf("= %.2f km\n", d);
-        
-        if(d < best_dist) {
-            best_dist = d;
-            best_idx = i;
-        }
-    }
-    printf("BEST: Person %d with %.2f km\n\n", best_idx+1, best_dist);
-    
-    // Now let's do ONE generation properly
-    
-    // Step 1: Keep the best (elitism)
-    int new_pop[5][6];
-    for(int j = 0; j < 6; j++) {
-        new_pop[0][j] = population[best_idx][j];
-    }
-    
-    // Step 2: Create children through crossover
-    printf("Creating Generation 1...\n");
-    
-    // Crossover example: Take Person 1 and Person 4
-    // Parent 1: 1 4 5 2 3 1
-    // Parent 4: 1 3 5 2 4 1
-    
-    // Pick segment from parent 1: positions 2-3 (4,5)
-    // Child starts: 1 4 5 _ _ 1
-    
-    // Fill from parent 4 in order: 3,5,2,4
-    // Already have 4,5, so use 3,2
-    // Child: 1 4 5 3 2 1
-    
-    int child[6] = {1, 4, 5, 3, 2, 1};
-    double child_dist = route_distance(child);
-    printf("Crossover child: 1 4 5 3 2 1 = %.2f km\n", child_dist);
-    
-    // Step 3: Try a mutation
-    // Take Person 2: 1 5 4 2 3 1
-    // Swap positions 2 and 4: 1 2 4 5 3 1
-    int mutated[6] = {1, 2, 4, 5, 3, 1};
-    double mut_dist = route_distance(mutated);
-    printf("Mutation: 1 2 4 5 3 1 = %.2f km\n", mut_dist);
-    
-    // What's the optimal route?
-    printf("\nLet's check ALL possible 5-city routes:\n");
-    printf("1→2→3→4→5→1 = %.2f km\n", route_distance((int[6]){1,2,3,4,5,1}));
-    printf("1→2→4→3→5→1 = %.2f km\n", route_distance((int[6]){1,2,4,3,5,1}));
-    printf("1→3→2→4→5→1 = %.2f km\n", route_distance((int[6]){1,3,2,4,5,1}));
-    printf("1→4→3→2→5→1 = %.2f km\n", route_distance((int[6]){1,4,3,2,5,1}));
-    
-    // The actual optimal for our made-up distances:
-    printf("\nOPTIMAL route for our example: 1→2→3→4→5→1 = 4.8 km\n");
-    
+    for(int g = 0; g <= generations; g++) {
+        best_idx = 0;
+        for(int i = 1; i < POP_SIZE; i++) {
+            if(fitness[i] < fitness[best_idx]) best_idx = i;
+        }
+
+        if(n_cities <= 10 && g == 0) {
+            printf("GENERATION 0 (Initial Random + local search):\n");
+            for(int i = 0; i < POP_SIZE; i++) {
+                printf("Person %d: ", i+1);
+                print_route(population + i * stride);
+                printf("= %.2f km\n", fitness[i]);
+            }
+        }
+        printf("Generation %d: BEST %.2f km\n", g, fitness[best_idx]);
+        if(g == generations) break;
+
+        //Keep the best (elitism)
+        memcpy(new_pop, population + best_idx * stride, sizeof(city_t) * stride);
+
+        //Children: crossover, mutation, then local search
+        for(int i = 1; i < POP_SIZE; i++) {
+            int a = tournament(fitness);
+            int b = tournament(fitness);
+            city_t* child = new_pop + i * stride;
+            crossover(population + a * stride, population + b * stride, child, used);
+            mutate(child);
+            local_search(child);
+        }
+
+        city_t* t = population;
+        population = new_pop;
+        new_pop = t;
+        evaluate_population(population, POP_SIZE, fitness);
+    }
+
+    TRACE_PHASE_END("evolve");
+    double length = fitness[best_idx];
+    memcpy(best, population + best_idx * stride, sizeof(city_t) * stride);
+    free(population);
+    free(new_pop);
+    free(used);
+    free(scratch);
+    return length;
+}
+
+//Benchmark entry point: same seed every run, so every run does the same work
+void bench_ga(void* tour) {
+    srand(BENCH_SEED);
+    run_ga(BENCH_GENERATIONS, tour);
+}
+
+int main(int argc, char* argv[]) {
+    if(bench_requested(argc, argv)) {
+        int saved = bench_mute_stdout();
+        srand(BENCH_SEED);
+        generate_cities(BENCH_CITIES, 0);
+        init_local_search();
+        bench_unmute_stdout(saved);
+
+        city_t* tour = malloc(sizeof(city_t) * n_cities);
+        bench_run("tsp_genetic", bench_ga, tour, 2, 20);
+        free(tour);
+        return 0;
+    }
+
+    //Usage: genetic [-f] [-x] [cities] [generations] [seed]
+    //0 cities = built-in example, -f = distances on the fly from coordinates,
+    //-x = exact Held-Karp check up to HK_MAX_CITIES instead of HK_AUTO_CITIES
+    int on_the_fly = 0, exact = 0;
+    while(argc > 1 && (strcmp(argv[1], "-f") == 0 || strcmp(argv[1], "-x") == 0)) {
+        if(argv[1][1] == 'f') on_the_fly = 1;
+        else exact = 1;
+        argv++;
+        argc--;
+    }
+    int cities = argc > 1 ? atoi(argv[1]) : 0;
+    int generations = argc > 2 ? atoi(argv[2]) : GENERATIONS;
+    unsigned seed = argc > 3 ? (unsigned)atoi(argv[3]) : (unsigned)time(NULL);
+    srand(seed);
+
+    if(cities > MAX_CITIES) {
+        printf("At most %d cities supported\n", MAX_CITIES);
+        return 1;
+    }
+    if(cities > 0 && cities < 3) {
+        printf("Usage: genetic [-f] [-x] [cities] [generations] [seed]\n");
+        printf("A tour needs at least 3 cities (0 = built-in example)\n");
+        return 1;
+    }
+    if(cities > 0) {
+        printf("=== RANDOM TSP: %d cities (seed %u) ===\n\n", cities, seed);
+        generate_cities(cities, on_the_fly);
+    } else {
+        printf("=== REAL TSP EXAMPLE ===\n\n");
+        load_example();
+    }
+
+    uint64_t start = bench_now_ns();
+    init_local_search();
+
+    city_t* best = malloc(sizeof(city_t) * n_cities);
+    double best_length = run_ga(generations, best);
+
+    double time_taken = bench_seconds_since(start);
+    printf("\nBest route: %.2f km (%.3f seconds)\n", best_length, time_taken);
+    if(n_cities <= 10) {
+        print_route(best);
+        printf("\n");
+    }
+
+    //What's the optimal route? Small instances get an exact answer, and
+    //with -x so do ones too slow to check by default
+    if(n_cities <= (exact ? HK_MAX_CITIES : HK_AUTO_CITIES)) {
+        city_t* optimal = malloc(sizeof(city_t) * n_cities);
+        TRACE_SCOPE("tsp_held_karp");
+        TRACE_PHASE_BEGIN("dp");
+        uint64_t hk_start = bench_now_ns();
+        double opt = held_karp(optimal);
+        double hk_time = bench_seconds_since(hk_start);
+        TRACE_PHASE_END("dp");
+
+        if(opt >= 0) {
+            printf("\nOPTIMAL route (Held-Karp, %.3f seconds): ", hk_time);
+            print_route(optimal);
+            printf("= %.2f km\n", opt);
+            printf("GA optimality gap: %.2f%%\n", 100.0 * (best_length - opt) / opt);
+        }
+        free(optimal);
+    } else if(n_cities <= HK_MAX_CITIES) {
+        printf("\nHeld-Karp skipped above %d cities, -x runs it up to %d\n",
+               HK_AUTO_CITIES, HK_MAX_CITIES);
+    }
+
+    free(best);
     return 0;
-}
\ No newline at end of file
+}